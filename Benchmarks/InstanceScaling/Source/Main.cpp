@@ -0,0 +1,445 @@
+/*
+  ==============================================================================
+
+    Multi-instance scaling benchmark for SimpleMBCompAudioProcessor.
+
+    Creates N processors and runs them from M threads the way a host's worker
+    pool does: every callback, the threads pull instances off a shared counter
+    until all N have processed one block, then wait for the next callback.
+    Callbacks run back to back (not paced to real time) so the numbers show
+    how much headroom a dense session has. It also reports the resident memory
+    each instance adds, measured from the process RSS.
+
+    With --mode construction it instead times, per instance, constructing a
+    processor and a getStateInformation() -> setStateInformation() round trip
+    of a session state with every parameter moved off its default.
+
+    Usage:
+      InstanceScaling [--mode scaling|construction]
+                      [--instances 1,16,64,256] [--threads 1,2,4,8]
+                      [--block 256] [--rate 48000] [--seconds 10]
+
+    Options take their value either as the next argument or after an '=',
+    e.g. --block 256 or --block=256.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include "../../../Source/PluginProcessor.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+namespace
+{
+struct Options
+{
+    juce::String mode { "scaling" };
+    std::vector<int> instanceCounts { 1, 16, 64, 256 };
+    std::vector<int> threadCounts { 1, 2, 4, 8 };
+    int blockSize = 256;
+    double sampleRate = 48000.0;
+    double secondsOfAudio = 10.0;
+};
+
+const char* const usage =
+    "Usage: InstanceScaling [--mode scaling|construction]\n"
+    "                       [--instances 1,16,64,256] [--threads 1,2,4,8]\n"
+    "                       [--block 256] [--rate 48000] [--seconds 10]\n";
+
+// Every value in the list must be a positive integer, otherwise the list is rejected
+std::vector<int> parseList(const juce::String& text)
+{
+    std::vector<int> values;
+    for(auto& token : juce::StringArray::fromTokens(text, ",", ""))
+    {
+        if(! token.trim().containsOnly("0123456789") || token.getIntValue() <= 0)
+            return {};
+        values.push_back(token.getIntValue());
+    }
+    return values;
+}
+
+// Finds "--name value" or "--name=value" and returns false if the option isn't given.
+// ArgumentList::getValueForOption() only understands the second form.
+bool getOptionValue(const juce::ArgumentList& args, const juce::String& option, juce::String& value)
+{
+    for(auto i = 0; i < args.arguments.size(); ++i)
+    {
+        auto& text = args.arguments.getReference(i).text;
+        
+        if(text == option)
+        {
+            value = i + 1 < args.arguments.size() ? args.arguments.getReference(i + 1).text : juce::String();
+            return true;
+        }
+        
+        if(text.startsWith(option + "="))
+        {
+            value = text.fromFirstOccurrenceOf("=", false, false);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Prints what is wrong and returns false, so main() can exit with an error
+bool parseOptions(const juce::ArgumentList& args, Options& options)
+{
+    auto fail = [](const juce::String& message)
+    {
+        std::cerr << message << "\n\n" << usage;
+        return false;
+    };
+    
+    juce::String value;
+    
+    if(getOptionValue(args, "--mode", value))
+        options.mode = value;
+    if(options.mode != "scaling" && options.mode != "construction")
+        return fail("--mode must be scaling or construction");
+    
+    if(getOptionValue(args, "--instances", value))
+        options.instanceCounts = parseList(value);
+    if(options.instanceCounts.empty())
+        return fail("--instances needs a comma separated list of positive counts");
+    
+    if(getOptionValue(args, "--threads", value))
+        options.threadCounts = parseList(value);
+    if(options.threadCounts.empty())
+        return fail("--threads needs a comma separated list of positive counts");
+    
+    if(getOptionValue(args, "--block", value))
+        options.blockSize = value.getIntValue();
+    if(options.blockSize <= 0)
+        return fail("--block must be a positive number of samples");
+    
+    if(getOptionValue(args, "--rate", value))
+        options.sampleRate = value.getDoubleValue();
+    if(options.sampleRate <= 0.0)
+        return fail("--rate must be a positive sample rate");
+    
+    if(getOptionValue(args, "--seconds", value))
+        options.secondsOfAudio = value.getDoubleValue();
+    if(options.secondsOfAudio <= 0.0)
+        return fail("--seconds must be a positive duration");
+    
+    return true;
+}
+
+// Resident set size of the whole process, 0 where it can't be read
+size_t getResidentBytes()
+{
+   #if JUCE_LINUX
+    auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), false);
+    return (size_t) fields[1].getLargeIntValue() * (size_t) sysconf(_SC_PAGESIZE);
+   #elif JUCE_MAC
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) == KERN_SUCCESS)
+        return (size_t) info.resident_size;
+    return 0;
+   #else
+    return 0;
+   #endif
+}
+
+// One plugin instance plus the buffers a host would own for it
+struct Instance
+{
+    SimpleMBCompAudioProcessor processor;
+    juce::AudioBuffer<float> buffer;
+    juce::AudioBuffer<float> source;
+    juce::MidiBuffer midi;
+    int sourcePosition = 0;
+    
+    Instance(const Options& options, juce::Random& random)
+    {
+        processor.setPlayConfigDetails(2, 2, options.sampleRate, options.blockSize);
+        processor.prepareToPlay(options.sampleRate, options.blockSize);
+        
+        buffer.setSize(2, options.blockSize);
+        
+        // A second of noise per instance, so instances don't all read the same memory
+        source.setSize(2, (int) options.sampleRate);
+        for(auto ch = 0; ch < source.getNumChannels(); ++ch)
+            for(auto i = 0; i < source.getNumSamples(); ++i)
+                source.setSample(ch, i, (random.nextFloat() * 2.f - 1.f) * 0.25f);
+    }
+    
+    void processNextBlock()
+    {
+        auto numSamples = buffer.getNumSamples();
+        if(sourcePosition + numSamples > source.getNumSamples())
+            sourcePosition = 0;
+        
+        for(auto ch = 0; ch < buffer.getNumChannels(); ++ch)
+            buffer.copyFrom(ch, 0, source, ch, sourcePosition, numSamples);
+        
+        sourcePosition += numSamples;
+        processor.processBlock(buffer, midi);
+    }
+};
+
+struct Result
+{
+    double realtimeFactor;      // seconds of audio for all instances per wall clock second
+    double p50, p99, p999;      // callback duration in ms
+    double overBudget;          // fraction of callbacks slower than one block of audio
+};
+
+double percentile(std::vector<double>& sorted, double p)
+{
+    auto index = (size_t) juce::jlimit(0.0, (double) sorted.size() - 1, std::ceil(p * (double) sorted.size()) - 1);
+    return sorted[index];
+}
+
+Result run(std::vector<std::unique_ptr<Instance>>& instances, int numThreads, const Options& options)
+{
+    auto numCallbacks = juce::jmax(1, (int) (options.secondsOfAudio * options.sampleRate / options.blockSize));
+    auto numInstances = (int) instances.size();
+    
+    std::atomic<int> nextInstance { 0 };
+    std::atomic<int> instancesDone { 0 };
+    std::atomic<int> callback { -1 };
+    std::atomic<bool> finished { false };
+    
+    auto work = [&]
+    {
+        for(auto i = nextInstance.fetch_add(1); i < numInstances; i = nextInstance.fetch_add(1))
+        {
+            instances[(size_t) i]->processNextBlock();
+            instancesDone.fetch_add(1, std::memory_order_release);
+        }
+    };
+    
+    // Helper threads wait for a callback to start, then join the main thread in pulling work
+    std::vector<std::thread> helpers;
+    for(auto t = 1; t < numThreads; ++t)
+    {
+        helpers.emplace_back([&]
+        {
+            juce::ScopedNoDenormals noDenormals;
+            auto seen = -1;
+            
+            while(! finished.load())
+            {
+                auto current = callback.load(std::memory_order_acquire);
+                if(current == seen)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                
+                seen = current;
+                work();
+            }
+        });
+    }
+    
+    std::vector<double> callbackMs;
+    callbackMs.reserve((size_t) numCallbacks);
+    
+    auto start = juce::Time::getHighResolutionTicks();
+    
+    for(auto c = 0; c < numCallbacks; ++c)
+    {
+        auto callbackStart = juce::Time::getHighResolutionTicks();
+        
+        instancesDone.store(0);
+        nextInstance.store(0);
+        callback.store(c, std::memory_order_release);
+        
+        work();
+        while(instancesDone.load(std::memory_order_acquire) < numInstances)
+            std::this_thread::yield();
+        
+        callbackMs.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - callbackStart) * 1000.0);
+    }
+    
+    auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    
+    finished.store(true);
+    for(auto& h : helpers)
+        h.join();
+    
+    auto budgetMs = 1000.0 * options.blockSize / options.sampleRate;
+    auto numOverBudget = std::count_if(callbackMs.begin(), callbackMs.end(), [budgetMs](double ms) { return ms > budgetMs; });
+    
+    std::sort(callbackMs.begin(), callbackMs.end());
+    
+    Result result;
+    result.realtimeFactor = (double) numInstances * numCallbacks * options.blockSize / options.sampleRate / elapsed;
+    result.p50 = percentile(callbackMs, 0.5);
+    result.p99 = percentile(callbackMs, 0.99);
+    result.p999 = percentile(callbackMs, 0.999);
+    result.overBudget = (double) numOverBudget / (double) numCallbacks;
+    return result;
+}
+
+void runScaling(const Options& options)
+{
+    std::cout << "SimpleMBComp instance scaling: block " << options.blockSize
+              << ", " << options.sampleRate << " Hz, " << options.secondsOfAudio << " s of audio per run" << std::endl
+              << "sizeof(SimpleMBCompAudioProcessor) = " << sizeof(SimpleMBCompAudioProcessor) << " bytes" << std::endl
+              << std::endl;
+    
+    std::cout << juce::String("instances").paddedLeft(' ', 10) << juce::String("threads").paddedLeft(' ', 9)
+              << juce::String("x realtime").paddedLeft(' ', 12) << juce::String("p50 ms").paddedLeft(' ', 10)
+              << juce::String("p99 ms").paddedLeft(' ', 10) << juce::String("p99.9 ms").paddedLeft(' ', 10)
+              << juce::String("over budget").paddedLeft(' ', 13) << juce::String("efficiency").paddedLeft(' ', 12)
+              << juce::String("scratch KB").paddedLeft(' ', 12) << juce::String("RSS KB/inst").paddedLeft(' ', 13) << std::endl;
+    
+    juce::Random random(0x5eed);
+    
+    for(auto numInstances : options.instanceCounts)
+    {
+        // Resident memory the instances add, including the heap state of the JUCE DSP
+        // members that sizeof() doesn't see. The harness's own per-instance buffers
+        // (block + one second of stereo noise) are subtracted. Run counts in ascending
+        // order, as memory freed by a larger run may stay resident and hide a smaller one.
+        auto residentBefore = getResidentBytes();
+        
+        std::vector<std::unique_ptr<Instance>> instances;
+        for(auto i = 0; i < numInstances; ++i)
+            instances.push_back(std::make_unique<Instance>(options, random));
+        
+        juce::SharedResourcePointer<BandScratchArena> arena;
+        
+        // One callback touches every instance's scratch and DSP state
+        auto touch = options;
+        touch.secondsOfAudio = options.blockSize / options.sampleRate;
+        run(instances, 1, touch);
+        
+        auto harnessBytes = (double) sizeof(float) * 2.0 * (options.blockSize + std::ceil(options.sampleRate));
+        auto residentPerInstance = ((double) getResidentBytes() - (double) residentBefore) / numInstances - harnessBytes;
+        
+        auto singleThreadFactor = 0.0;
+        
+        for(auto numThreads : options.threadCounts)
+        {
+            // Warm up caches and the compressors' envelopes before measuring
+            auto warmUp = options;
+            warmUp.secondsOfAudio = juce::jmin(1.0, options.secondsOfAudio);
+            run(instances, numThreads, warmUp);
+            
+            auto result = run(instances, numThreads, options);
+            
+            // Efficiency relative to the first thread count in the list, scaled per thread
+            if(singleThreadFactor == 0.0)
+                singleThreadFactor = result.realtimeFactor / numThreads;
+            auto efficiency = result.realtimeFactor / (singleThreadFactor * numThreads);
+            
+            std::cout << juce::String(numInstances).paddedLeft(' ', 10)
+                      << juce::String(numThreads).paddedLeft(' ', 9)
+                      << juce::String(result.realtimeFactor, 1).paddedLeft(' ', 12)
+                      << juce::String(result.p50, 3).paddedLeft(' ', 10)
+                      << juce::String(result.p99, 3).paddedLeft(' ', 10)
+                      << juce::String(result.p999, 3).paddedLeft(' ', 10)
+                      << (juce::String(result.overBudget * 100.0, 2) + "%").paddedLeft(' ', 13)
+                      << (juce::String(efficiency * 100.0, 1) + "%").paddedLeft(' ', 12)
+                      << juce::String((double) arena->getReservedBytes() / 1024.0, 1).paddedLeft(' ', 12)
+                      << juce::String(residentPerInstance / 1024.0, 1).paddedLeft(' ', 13)
+                      << std::endl;
+        }
+    }
+}
+
+struct Stats
+{
+    double mean, p99;
+};
+
+Stats getStats(std::vector<double> ms)
+{
+    std::sort(ms.begin(), ms.end());
+    return { std::accumulate(ms.begin(), ms.end(), 0.0) / (double) ms.size(), percentile(ms, 0.99) };
+}
+
+void runConstruction(const Options& options)
+{
+    std::cout << "SimpleMBComp construction and state restore, per instance" << std::endl
+              << std::endl;
+    
+    std::cout << juce::String("instances").paddedLeft(' ', 10)
+              << juce::String("construct mean ms").paddedLeft(' ', 19) << juce::String("construct p99 ms").paddedLeft(' ', 18)
+              << juce::String("state mean ms").paddedLeft(' ', 15) << juce::String("state p99 ms").paddedLeft(' ', 14) << std::endl;
+    
+    juce::Random random(0x5eed);
+    
+    // A saved session rarely has everything at its default, so move every parameter first
+    juce::MemoryBlock sessionState;
+    {
+        SimpleMBCompAudioProcessor source;
+        for(auto* parameter : source.getParameters())
+            parameter->setValueNotifyingHost(random.nextFloat());
+        
+        // apvts only copies parameter values into its tree on a timer, copyState() flushes them now
+        source.apvts.copyState();
+        source.getStateInformation(sessionState);
+    }
+    
+    for(auto numInstances : options.instanceCounts)
+    {
+        std::vector<std::unique_ptr<SimpleMBCompAudioProcessor>> processors;
+        std::vector<double> constructMs, stateMs;
+        processors.reserve((size_t) numInstances);
+        
+        for(auto i = 0; i < numInstances; ++i)
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+            processors.push_back(std::make_unique<SimpleMBCompAudioProcessor>());
+            constructMs.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+        }
+        
+        for(auto& processor : processors)
+            processor->setStateInformation(sessionState.getData(), (int) sessionState.getSize());
+        
+        for(auto& processor : processors)
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+            
+            juce::MemoryBlock state;
+            processor->getStateInformation(state);
+            processor->setStateInformation(state.getData(), (int) state.getSize());
+            
+            stateMs.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0);
+        }
+        
+        auto construct = getStats(constructMs);
+        auto state = getStats(stateMs);
+        
+        std::cout << juce::String(numInstances).paddedLeft(' ', 10)
+                  << juce::String(construct.mean, 4).paddedLeft(' ', 19)
+                  << juce::String(construct.p99, 4).paddedLeft(' ', 18)
+                  << juce::String(state.mean, 4).paddedLeft(' ', 15)
+                  << juce::String(state.p99, 4).paddedLeft(' ', 14)
+                  << std::endl;
+    }
+}
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ScopedNoDenormals noDenormals;
+    
+    Options options;
+    if(! parseOptions(juce::ArgumentList(argc, argv), options))
+        return 1;
+    
+    if(options.mode == "construction")
+        runConstruction(options);
+    else
+        runScaling(options);
+    
+    return 0;
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ Scratch memory for the transient band buffers used by splitBands(), and for the
+ mono sidechain detector bands used by splitDetectorBands().
+
+ Band buffers only live for the duration of one processBlock() call, so there is
+ no reason for every plugin instance to own its own copy. All instances in the
+ process share one BandScratchArena (via juce::SharedResourcePointer) and borrow a
+ slab for the length of a processBlock() call. Each audio thread remembers the slab
+ it used last, so instances running back to back on the same thread keep reusing
+ the same (cache-warm) memory.
+
+ Slabs are fixed size: processBlock() walks the host buffer in chunks of at most
+ maxSamples so that the arena never needs to grow at process time. Slabs are only
+ ever created from prepareToPlay(), and never freed until the last instance goes.
+ Borrowing a slab never waits. When the pool is empty the caller processes the block
+ through a StackBandSlab instead: the same band buffers, only stackSamples long, so the
+ block is walked in smaller chunks and the output is identical.
+
+ The detector bands have their own pool, which stays empty until an instance is
+ prepared with its sidechain bus enabled, and the same StackDetectorSlab fallback.
+ */
+
+struct BandScratchArena
+{
+    static constexpr int numBands = 3;
+    static constexpr int maxChannels = 2;
+    static constexpr int maxSamples = 512;
+    static constexpr int maxSlabs = 128;
+    static constexpr int stackSamples = 64;
+
+    // 64 bytes covers AVX-512 loads and keeps each channel on its own cache lines
+    static constexpr size_t alignment = 64;
+
+    static_assert((maxSamples * sizeof(float)) % alignment == 0 && (stackSamples * sizeof(float)) % alignment == 0,
+                  "every band channel must start on an aligned boundary");
+
+    // Pointers to one slab's band channels, whichever length it was made with
+    struct BandBuffers
+    {
+        std::array<std::array<float*, maxChannels>, numBands> channels;
+        int numSamples;
+    };
+
+    template <int length>
+    struct alignas(alignment) BasicBandSlab
+    {
+        float samples[numBands][maxChannels][length];
+        
+        float* getChannel(int band, int channel) { return samples[band][channel]; }
+        
+        BandBuffers getBuffers()
+        {
+            BandBuffers buffers;
+            for(auto band = 0; band < numBands; ++band)
+                for(auto ch = 0; ch < maxChannels; ++ch)
+                    buffers.channels[(size_t) band][(size_t) ch] = samples[band][ch];
+            buffers.numSamples = length;
+            return buffers;
+        };
+    };
+
+    using BandSlab = BasicBandSlab<maxSamples>;
+    
+    // 1.5 KB, small enough to live on the audio thread's stack
+    using StackBandSlab = BasicBandSlab<stackSamples>;
+
+    struct DetectorBuffers
+    {
+        std::array<float*, numBands> bands;
+        int numSamples;
+    };
+
+    template <int length>
+    struct alignas(alignment) BasicDetectorSlab
+    {
+        float samples[numBands][length];
+        
+        float* getBand(int band) { return samples[band]; }
+        
+        DetectorBuffers getBuffers()
+        {
+            DetectorBuffers buffers;
+            for(auto band = 0; band < numBands; ++band)
+                buffers.bands[(size_t) band] = samples[band];
+            buffers.numSamples = length;
+            return buffers;
+        };
+    };
+
+    using DetectorSlab = BasicDetectorSlab<maxSamples>;
+    using StackDetectorSlab = BasicDetectorSlab<stackSamples>;
+
+    template <typename SlabType>
+    class Pool
+    {
+        struct alignas(alignment) Entry
+        {
+            SlabType slab;
+            
+            alignas(alignment) std::atomic<bool> inUse { false };
+        };
+        
+    public:
+        // Called from prepareToPlay(). Normally there are no more processBlock() calls in flight
+        // than there are worker threads, so the pool starts at 2 slabs per CPU and only grows
+        // past that, one CPU's worth at a time, once calls have actually found it empty (e.g.
+        // an offline render thread running beside the realtime ones).
+        void reserve(int numInstances)
+        {
+            const juce::ScopedLock sl(reserveLock);
+
+            auto numCpus = juce::SystemStats::getNumCpus();
+            auto wanted = juce::jmax(4, 2 * numCpus);
+            
+            auto failures = failedAcquires.load(std::memory_order_relaxed);
+            if(failures > failuresSeen)
+            {
+                wanted = juce::jmax(wanted, numSlabs.load() + numCpus);
+                failuresSeen = failures;
+            }
+            
+            auto target = juce::jmin(numInstances, wanted, maxSlabs);
+
+            for(auto i = numSlabs.load(); i < target; ++i)
+            {
+                entries[(size_t) i] = std::make_unique<Entry>();
+                numSlabs.store(i + 1, std::memory_order_release);
+            }
+        };
+
+        size_t getReservedBytes() const
+        {
+            return (size_t) numSlabs.load() * sizeof(Entry);
+        };
+
+        // Borrows a slab for the lifetime of the object. Never blocks and never allocates,
+        // so isValid() is false when every slab is taken (or the pool is null): the caller
+        // then uses its stack slab for this block.
+        class Scoped
+        {
+        public:
+            explicit Scoped(Pool* p)
+                : pool(p),
+                  pooled(pool != nullptr ? pool->tryAcquire() : nullptr) {}
+            
+            ~Scoped()
+            {
+                if(pooled != nullptr)
+                    pool->release(*pooled);
+            }
+
+            bool isValid() const { return pooled != nullptr; }
+            SlabType& operator*() const { return pooled->slab; }
+            SlabType* operator->() const { return &pooled->slab; }
+
+        private:
+            Pool* pool;
+            Entry* pooled;
+
+            JUCE_DECLARE_NON_COPYABLE(Scoped)
+        };
+
+    private:
+        Entry* tryAcquire()
+        {
+            // Seeded per thread so that audio threads start their scan on different slabs
+            static thread_local int preferredSlab = (int) (std::hash<std::thread::id>{}(std::this_thread::get_id()) % maxSlabs);
+
+            // Zero before prepareToPlay() has run anywhere
+            auto count = numSlabs.load(std::memory_order_acquire);
+
+            for(auto i = 0; i < count; ++i)
+            {
+                auto index = (preferredSlab + i) % count;
+                auto* entry = entries[(size_t) index].get();
+
+                if(! entry->inUse.exchange(true, std::memory_order_acquire))
+                {
+                    preferredSlab = index;
+                    return entry;
+                }
+            };
+
+            // No wait here: a realtime thread must not spin on a slab held by a preempted thread.
+            // Only this path touches a shared counter, which lets the next prepareToPlay() grow the pool.
+            failedAcquires.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        };
+
+        void release(Entry& entry)
+        {
+            entry.inUse.store(false, std::memory_order_release);
+        };
+
+        std::array<std::unique_ptr<Entry>, maxSlabs> entries;
+        
+        // numSlabs is read by every acquire and only written by reserve(), so it gets a line of
+        // its own rather than sharing one with the counter written on the failure path
+        alignas(alignment) std::atomic<int> numSlabs { 0 };
+        alignas(alignment) std::atomic<int> failedAcquires { 0 };
+        int failuresSeen { 0 };
+        juce::CriticalSection reserveLock;
+    };
+
+    using ScopedBands = Pool<BandSlab>::Scoped;
+    using ScopedDetector = Pool<DetectorSlab>::Scoped;
+
+    Pool<BandSlab> bands;
+    Pool<DetectorSlab> detectors;
+
+    size_t getReservedBytes() const
+    {
+        return bands.getReservedBytes() + detectors.getReservedBytes();
+    };
+};
@@ -0,0 +1,197 @@
+/*
+  ==============================================================================
+
+    K-weighting filter coefficients follow ITU-R BS.1770-4, recomputed for the
+    actual sample rate so the meter is valid at rates other than 48kHz.
+
+  ==============================================================================
+*/
+
+#include "LoudnessMeter.h"
+
+void LoudnessMeter::prepare(double sampleRate, int numChannels)
+{
+    jassert(numChannels <= maxChannels);
+    numChannelsToMeasure = juce::jmin(numChannels, maxChannels);
+    samplesPerStep = juce::roundToInt(sampleRate * 0.1);
+    
+    // Stage 1: high shelf, +4dB above ~1.7kHz, modelling the acoustic effect of the head
+    {
+        const auto f0 = 1681.974450955533;
+        const auto gainDb = 3.999843853973347;
+        const auto q = 0.7071752369554196;
+        
+        const auto k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const auto vh = std::pow(10.0, gainDb / 20.0);
+        const auto vb = std::pow(vh, 0.4996667741545416);
+        const auto a0 = 1.0 + k / q + k * k;
+        
+        for(auto& f : filters)
+        {
+            f.shelf.b0 = (vh + vb * k / q + k * k) / a0;
+            f.shelf.b1 = 2.0 * (k * k - vh) / a0;
+            f.shelf.b2 = (vh - vb * k / q + k * k) / a0;
+            f.shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+            f.shelf.a2 = (1.0 - k / q + k * k) / a0;
+        };
+    }
+    
+    // Stage 2: the RLB high pass at ~38Hz
+    {
+        const auto f0 = 38.13547087602444;
+        const auto q = 0.5003270373238773;
+        
+        const auto k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        const auto a0 = 1.0 + k / q + k * k;
+        
+        for(auto& f : filters)
+        {
+            f.highPass.b0 = 1.0;
+            f.highPass.b1 = -2.0;
+            f.highPass.b2 = 1.0;
+            f.highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+            f.highPass.a2 = (1.0 - k / q + k * k) / a0;
+        };
+    }
+    
+    reset();
+}
+
+void LoudnessMeter::reset()
+{
+    for(auto& f : filters)
+    {
+        f.shelf.z1 = f.shelf.z2 = 0.0;
+        f.highPass.z1 = f.highPass.z2 = 0.0;
+    };
+    
+    samplesInStep = 0;
+    stepEnergy = 0.0;
+    
+    stepEnergies.fill(0.0);
+    stepWriteIndex = 0;
+    numStepsStored = 0;
+    
+    histogramCounts.fill(0);
+    histogramEnergies.fill(0.0);
+    numGatedBlocks = 0;
+    gatedEnergy = 0.0;
+    
+    const auto silence = -std::numeric_limits<float>::infinity();
+    momentary.store(silence);
+    shortTerm.store(silence);
+    integrated.store(silence);
+}
+
+void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer)
+{
+    jassert(samplesPerStep > 0); // prepare() has not been called
+    
+    auto numChannels = juce::jmin(numChannelsToMeasure, buffer.getNumChannels());
+    auto numSamples = buffer.getNumSamples();
+    
+    // Run each channel up to the next step boundary, then close the step
+    for(auto start = 0; start < numSamples; )
+    {
+        auto n = juce::jmin(numSamples - start, samplesPerStep - samplesInStep);
+        
+        for(auto ch = 0; ch < numChannels; ++ch)
+        {
+            auto& f = filters[(size_t) ch];
+            auto* data = buffer.getReadPointer(ch, start);
+            
+            auto sum = 0.0;
+            for(auto i = 0; i < n; ++i)
+            {
+                auto y = f.highPass.processSample(f.shelf.processSample(data[i]));
+                sum += y * y;
+            };
+            
+            // Left and right both have a channel weighting of 1.0
+            stepEnergy += sum;
+        };
+        
+        start += n;
+        samplesInStep += n;
+        
+        if(samplesInStep == samplesPerStep)
+            finishStep();
+    };
+}
+
+float LoudnessMeter::energyToLoudness(double meanSquare)
+{
+    if(meanSquare <= 0.0)
+        return -std::numeric_limits<float>::infinity();
+    
+    return (float) (-0.691 + 10.0 * std::log10(meanSquare));
+}
+
+void LoudnessMeter::finishStep()
+{
+    stepEnergies[(size_t) stepWriteIndex] = stepEnergy / samplesPerStep;
+    stepWriteIndex = (stepWriteIndex + 1) % stepsPerShortTerm;
+    numStepsStored = juce::jmin(numStepsStored + 1, stepsPerShortTerm);
+    
+    samplesInStep = 0;
+    stepEnergy = 0.0;
+    
+    // Walk back from the newest step. The ring is only 30 entries, so summing it
+    // again is cheap and avoids the drift of a running sum.
+    auto sum = 0.0;
+    for(auto i = 1; i <= numStepsStored; ++i)
+    {
+        sum += stepEnergies[(size_t) ((stepWriteIndex - i + stepsPerShortTerm) % stepsPerShortTerm)];
+        
+        if(i == stepsPerMomentary)
+        {
+            auto blockMeanSquare = sum / stepsPerMomentary;
+            momentary.store(energyToLoudness(blockMeanSquare), std::memory_order_relaxed);
+            
+            // Each step completes a new 400ms gating block (75% overlap)
+            addGatingBlock(blockMeanSquare);
+        };
+    };
+    
+    if(numStepsStored == stepsPerShortTerm)
+        shortTerm.store(energyToLoudness(sum / stepsPerShortTerm), std::memory_order_relaxed);
+}
+
+void LoudnessMeter::addGatingBlock(double meanSquare)
+{
+    auto loudness = energyToLoudness(meanSquare);
+    if(loudness <= absoluteGate)
+        return;
+    
+    auto bin = juce::jlimit(0, numHistogramBins - 1, (int) ((loudness - absoluteGate) * histogramBinsPerLU));
+    
+    ++histogramCounts[(size_t) bin];
+    histogramEnergies[(size_t) bin] += meanSquare;
+    
+    ++numGatedBlocks;
+    gatedEnergy += meanSquare;
+    
+    integrated.store(computeIntegratedLoudness(), std::memory_order_relaxed);
+}
+
+float LoudnessMeter::computeIntegratedLoudness() const
+{
+    // The relative gate is 10 LU below the loudness of everything above the absolute gate.
+    // Bins keep the exact energy of their blocks, so only the gate edge is quantised to 0.1 LU.
+    auto gate = energyToLoudness(gatedEnergy / (double) numGatedBlocks) + relativeGate;
+    auto firstBin = juce::jlimit(0, numHistogramBins, (int) std::ceil((gate - absoluteGate) * histogramBinsPerLU));
+    
+    uint64_t count = 0;
+    auto energy = 0.0;
+    
+    for(auto bin = firstBin; bin < numHistogramBins; ++bin)
+    {
+        count += histogramCounts[(size_t) bin];
+        energy += histogramEnergies[(size_t) bin];
+    };
+    
+    if(count == 0)
+        return -std::numeric_limits<float>::infinity();
+    
+    return energyToLoudness(energy / (double) count);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ EBU R128 / ITU-R BS.1770 loudness meter.
+
+ The signal is K-weighted per channel and its energy is collected in 100ms steps.
+ Momentary (400ms) and short-term (3s) loudness are read from a small ring of step
+ energies, and every 400ms gating block is added to a fixed-size histogram so the
+ integrated loudness costs the same and uses the same memory however long it runs.
+
+ process() is meant for the audio thread. The getters can be called from any thread,
+ and return -inf (in LUFS) until there is enough signal to measure.
+ */
+
+class LoudnessMeter
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr float absoluteGate = -70.f;  // LUFS
+    static constexpr float relativeGate = -10.f;  // LU
+
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+    
+    void process(const juce::AudioBuffer<float>& buffer);
+    
+    float getMomentaryLoudness() const { return momentary.load(std::memory_order_relaxed); }
+    float getShortTermLoudness() const { return shortTerm.load(std::memory_order_relaxed); }
+    float getIntegratedLoudness() const { return integrated.load(std::memory_order_relaxed); }
+    
+private:
+    // Transposed direct form II, in double so the 38Hz high pass stays accurate
+    struct Biquad
+    {
+        double b0 { 1 }, b1 { 0 }, b2 { 0 }, a1 { 0 }, a2 { 0 };
+        double z1 { 0 }, z2 { 0 };
+        
+        double processSample(double x)
+        {
+            auto y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        };
+    };
+    
+    struct KWeighting
+    {
+        Biquad shelf, highPass;
+    };
+    
+    static constexpr int stepsPerMomentary = 4;     // 400ms
+    static constexpr int stepsPerShortTerm = 30;    // 3s
+    
+    // 0.1 LU resolution from the absolute gate up to +5 LUFS
+    static constexpr int histogramBinsPerLU = 10;
+    static constexpr float histogramTop = 5.f;
+    static constexpr int numHistogramBins = (int) (histogramTop - absoluteGate) * histogramBinsPerLU;
+    
+    static float energyToLoudness(double meanSquare);
+    
+    void finishStep();
+    void addGatingBlock(double meanSquare);
+    float computeIntegratedLoudness() const;
+    
+    std::array<KWeighting, maxChannels> filters;
+    int numChannelsToMeasure { 0 };
+    
+    int samplesPerStep { 0 };
+    int samplesInStep { 0 };
+    double stepEnergy { 0 };
+    
+    std::array<double, stepsPerShortTerm> stepEnergies {};
+    int stepWriteIndex { 0 };
+    int numStepsStored { 0 };
+    
+    std::array<uint32_t, numHistogramBins> histogramCounts {};
+    std::array<double, numHistogramBins> histogramEnergies {};
+    uint64_t numGatedBlocks { 0 };
+    double gatedEnergy { 0 };
+    
+    std::atomic<float> momentary { -std::numeric_limits<float>::infinity() };
+    std::atomic<float> shortTerm { -std::numeric_limits<float>::infinity() };
+    std::atomic<float> integrated { -std::numeric_limits<float>::infinity() };
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+ Every plugin parameter is described once in the table below. createParameterLayout()
+ builds the parameters from it and the processor constructor binds its typed pointers
+ from it, in table order, without any string lookups or dynamic_casts.
+
+ The order of the table is the order the host sees, and the IDs are stored in sessions,
+ so only ever append to it.
+ */
+
+namespace Params
+{
+    enum class Type { Float, Choice, Bool };
+
+    // Which processor member a parameter gets bound to
+    enum class Binding
+    {
+        InputGain, OutputGain,
+        LowMidCrossover, MidHighCrossover,
+        Threshold, Attack, Release, Ratio, Bypass, Solo, Mute,
+        AutoGain,
+        ExternalKey
+    };
+
+    struct Range
+    {
+        float start, end, interval, skew;
+    };
+
+    struct Descriptor
+    {
+        const char* id;
+        const char* name;
+        Type type;
+        Binding binding;
+        int band;               // index into compressorbands, -1 for global parameters
+        Range range;            // unused for Choice and Bool
+        float defaultValue;     // choice index for Choice, 0 or 1 for Bool
+        
+        // Only set for Choice
+        const char* const* choiceNames { nullptr };
+        int numChoices { 0 };
+    };
+
+    inline constexpr int versionHint = 1;
+
+    inline constexpr Range gainRange { -24.f, 24.f, 0.5f, 1.f };
+    inline constexpr Range thresholdRange { -60.f, 12.f, 1.f, 1.f };
+    // Minimal time of 5ms and maximal of 500ms, linear steps of 1ms
+    inline constexpr Range attackReleaseRange { 5.f, 500.f, 1.f, 1.f };
+    inline constexpr Range lowMidCrossoverRange { 20.f, 999.f, 1.f, 1.f };
+    inline constexpr Range midHighCrossoverRange { 1000.f, 20000.f, 1.f, 1.f };
+    inline constexpr Range noRange { 0.f, 1.f, 1.f, 1.f };
+
+    inline constexpr std::array<float, 14> ratioChoices
+    {
+        1.f, 1.5f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 10.f, 15.f, 20.f, 50.f, 100.f
+    };
+
+    inline constexpr std::array<const char*, ratioChoices.size()> ratioChoiceNames
+    {
+        "1.0", "1.5", "2.0", "3.0", "4.0", "5.0", "6.0", "7.0", "8.0", "10.0", "15.0", "20.0", "50.0", "100.0"
+    };
+
+    inline constexpr Descriptor descriptors[]
+    {
+        // Input and Output Gain
+        { "Input_Gain",  "Input Gain",  Type::Float, Binding::InputGain,  -1, gainRange, 0.f },
+        { "Output_Gain", "Output Gain", Type::Float, Binding::OutputGain, -1, gainRange, 0.f },
+        
+        //Low Band Compressor
+        { "Threshold_Low_Band", "Threshold Low Band", Type::Float,  Binding::Threshold, 0, thresholdRange,     0.f },
+        { "Attack_Low_Band",    "Attack Low Band",    Type::Float,  Binding::Attack,    0, attackReleaseRange, 0.f },
+        { "Release_Low_Band",   "Release Low Band",   Type::Float,  Binding::Release,   0, attackReleaseRange, 0.f },
+        { "Ratio_Low_Band",     "Ratio Low Band",     Type::Choice, Binding::Ratio,     0, noRange,            3.f, ratioChoiceNames.data(), (int) ratioChoiceNames.size() },
+        { "Bypass_Low_Band",    "Bypass Low Band",    Type::Bool,   Binding::Bypass,    0, noRange,            0.f },
+        { "Solo_Low_Band",      "Solo Low Band",      Type::Bool,   Binding::Solo,      0, noRange,            0.f },
+        { "Mute_Low_Band",      "Mute Low Band",      Type::Bool,   Binding::Mute,      0, noRange,            0.f },
+        
+        // Mid Band Compressor
+        { "Threshold_Mid_Band", "Threshold Mid Band", Type::Float,  Binding::Threshold, 1, thresholdRange,     0.f },
+        { "Attack_Mid_Band",    "Attack Mid Band",    Type::Float,  Binding::Attack,    1, attackReleaseRange, 0.f },
+        { "Release_Mid_Band",   "Release Mid Band",   Type::Float,  Binding::Release,   1, attackReleaseRange, 0.f },
+        { "Ratio_Mid_Band",     "Ratio Mid Band",     Type::Choice, Binding::Ratio,     1, noRange,            3.f, ratioChoiceNames.data(), (int) ratioChoiceNames.size() },
+        { "Bypass_Mid_Band",    "Bypass Mid Band",    Type::Bool,   Binding::Bypass,    1, noRange,            0.f },
+        { "Solo_Mid_Band",      "Solo Mid Band",      Type::Bool,   Binding::Solo,      1, noRange,            0.f },
+        { "Mute_Mid_Band",      "Mute Mid Band",      Type::Bool,   Binding::Mute,      1, noRange,            0.f },
+        
+        // High Band Compressor
+        { "Threshold_High_Band", "Threshold High Band", Type::Float,  Binding::Threshold, 2, thresholdRange,     0.f },
+        { "Attack_High_Band",    "Attack High Band",    Type::Float,  Binding::Attack,    2, attackReleaseRange, 0.f },
+        { "Release_High_Band",   "Release High Band",   Type::Float,  Binding::Release,   2, attackReleaseRange, 0.f },
+        { "Ratio_High_Band",     "Ratio High Band",     Type::Choice, Binding::Ratio,     2, noRange,            3.f, ratioChoiceNames.data(), (int) ratioChoiceNames.size() },
+        { "Bypass_High_Band",    "Bypass High Band",    Type::Bool,   Binding::Bypass,    2, noRange,            0.f },
+        { "Solo_High_Band",      "Solo High Band",      Type::Bool,   Binding::Solo,      2, noRange,            0.f },
+        { "Mute_High_Band",      "Mute High Band",      Type::Bool,   Binding::Mute,      2, noRange,            0.f },
+        
+        //Crossover Freq Parameters
+        { "Low_Mid_Crossover_Freq",  "Low-Mid Crossover Freq",  Type::Float, Binding::LowMidCrossover,  -1, lowMidCrossoverRange,  400.f },
+        { "Mid-High Crossover Freq", "Mid-High Crossover Freq", Type::Float, Binding::MidHighCrossover, -1, midHighCrossoverRange, 2000.f },
+        
+        // Matches the output loudness to the input loudness on top of Output Gain. The
+        // correction it has settled on is not a parameter, it is saved with the session
+        // as the autoGainCorrectionProperty of the state tree.
+        { "Auto_Gain", "Auto Gain", Type::Bool, Binding::AutoGain, -1, noRange, 0.f },
+        
+        // Keys the band compressors from the sidechain input. Hosts enable the sidechain bus
+        // whether or not anything is routed to it, so this is the user's explicit choice.
+        { "External_Key", "External Key", Type::Bool, Binding::ExternalKey, -1, noRange, 0.f },
+    };
+
+    inline constexpr size_t numParameters = std::size(descriptors);
+
+    inline constexpr const char* autoGainCorrectionProperty = "Auto_Gain_Correction";
+
+    constexpr bool stringsEqual(const char* a, const char* b)
+    {
+        while(*a != '\0' && *a == *b)
+        {
+            ++a;
+            ++b;
+        }
+        return *a == *b;
+    }
+
+    constexpr bool idsAreUnique()
+    {
+        for(size_t i = 0; i < numParameters; ++i)
+            for(size_t j = i + 1; j < numParameters; ++j)
+                if(stringsEqual(descriptors[i].id, descriptors[j].id))
+                    return false;
+        return true;
+    }
+
+    static_assert(idsAreUnique(), "parameter IDs must be unique");
+
+    constexpr bool choicesAreSet()
+    {
+        for(const auto& d : descriptors)
+            if((d.type == Type::Choice) != (d.choiceNames != nullptr && d.numChoices > 0))
+                return false;
+        return true;
+    }
+
+    static_assert(choicesAreSet(), "Choice parameters, and only those, need choice names");
+}
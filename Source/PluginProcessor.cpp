@@ -16,43 +16,19 @@ SimpleMBCompAudioProcessor::SimpleMBCompAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       ), apvts(*this, nullptr, "Parameters", createParameterLayout())
+                       )
 #endif
 {
+    // apvts adds the parameters in descriptor table order, so they can be bound by index
+    auto& parameters = getParameters();
+    jassert(parameters.size() == (int) Params::numParameters);
     
-    //floatHelper lambda function
-    auto floatHelper = [&apvts = this->apvts](auto& parameter, const auto& parameterName)
-    {
-        parameter = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter(parameterName));
-        jassert(parameter != nullptr);
-    };
-
-    //choiceHelper Lambda
-    auto choiceHelper = [&apvts = this->apvts](auto& parameter, const auto& parameterName)
-    {
-       parameter = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter(parameterName));
-        jassert(parameter != nullptr);
-    };
-
-    //boolHelper Lambda
-    auto boolHelper = [&apvts = this->apvts](auto& parameter, const auto& parameterName)
-    {
-        parameter = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter(parameterName));
-        jassert(parameter != nullptr);
-    };
-
-    // Using the parameterList StringArray, apply the float helper functions
-    
-    // Input and output Gain
-    floatHelper(inputGainParam, SimpleMBCompAudioProcessor::GAIN_IN_ID.getParamID());
-    floatHelper(outputGainParam, SimpleMBCompAudioProcessor::GAIN_OUT_ID.getParamID());
-    
-    //Crossover Frequencies
-    floatHelper(lowMidCrossover, SimpleMBCompAudioProcessor::LOW_MID_CROSSOVER_FREQ_ID.getParamID() );
-    floatHelper(midHighCrossover, SimpleMBCompAudioProcessor::MID_HIGH_CROSSOVER_FREQ_ID.getParamID() );
+    for(size_t i = 0; i < Params::numParameters; ++i)
+        bindParameter(Params::descriptors[i], *parameters[(int) i]);
     
     LP1.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
     AP2.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
@@ -60,42 +36,39 @@ SimpleMBCompAudioProcessor::SimpleMBCompAudioProcessor()
     HP1.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
     LP2.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
     HP2.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
+}
+
+void SimpleMBCompAudioProcessor::bindParameter(const Params::Descriptor& descriptor, juce::AudioProcessorParameter& parameter)
+{
+    jassert(static_cast<juce::RangedAudioParameter&>(parameter).getParameterID() == descriptor.id);
     
-    //Compressor Low Band
-    floatHelper(lowBandComp.attack, SimpleMBCompAudioProcessor::ATTACK_LOW_BAND_ID.getParamID() );
-    floatHelper(lowBandComp.release, SimpleMBCompAudioProcessor::RELEASE_LOW_BAND_ID.getParamID() );
-    floatHelper(lowBandComp.threshold, SimpleMBCompAudioProcessor::THRESHOLD_LOW_BAND_ID.getParamID() );
-    
-    choiceHelper(lowBandComp.ratio, SimpleMBCompAudioProcessor::RATIO_LOW_BAND_ID.getParamID() );
-    
-    boolHelper(lowBandComp.bypass, SimpleMBCompAudioProcessor::BYPASS_LOW_BAND_ID.getParamID() );
-    boolHelper(lowBandComp.solo, SimpleMBCompAudioProcessor::SOLO_LOW_BAND_ID.getParamID() );
-    boolHelper(lowBandComp.mute, SimpleMBCompAudioProcessor::MUTE_LOW_BAND_ID.getParamID() );
-    
-    //Compressor mid Band
-    floatHelper(midBandComp.attack, SimpleMBCompAudioProcessor::ATTACK_MID_BAND_ID.getParamID() );
-    floatHelper(midBandComp.release, SimpleMBCompAudioProcessor::RELEASE_MID_BAND_ID.getParamID() );
-    floatHelper(midBandComp.threshold, SimpleMBCompAudioProcessor::THRESHOLD_MID_BAND_ID.getParamID() );
-    
-    choiceHelper(midBandComp.ratio, SimpleMBCompAudioProcessor::RATIO_MID_BAND_ID.getParamID() );
-    
-    boolHelper(midBandComp.bypass, SimpleMBCompAudioProcessor::BYPASS_MID_BAND_ID.getParamID() );
-    boolHelper(midBandComp.solo, SimpleMBCompAudioProcessor::SOLO_MID_BAND_ID.getParamID() );
-    boolHelper(midBandComp.mute, SimpleMBCompAudioProcessor::MUTE_MID_BAND_ID.getParamID() );
-    
-    //Compressor high Band
-    floatHelper(highBandComp.attack, SimpleMBCompAudioProcessor::ATTACK_HIGH_BAND_ID.getParamID() );
-    floatHelper(highBandComp.release, SimpleMBCompAudioProcessor::RELEASE_HIGH_BAND_ID.getParamID() );
-    floatHelper(highBandComp.threshold, SimpleMBCompAudioProcessor::THRESHOLD_HIGH_BAND_ID.getParamID() );
-    
-    choiceHelper(highBandComp.ratio, SimpleMBCompAudioProcessor::RATIO_HIGH_BAND_ID.getParamID() );
+    // The descriptor type decides which class createParameterLayout() made, so no dynamic_cast is needed
+    auto* floatParam = descriptor.type == Params::Type::Float ? static_cast<juce::AudioParameterFloat*>(&parameter) : nullptr;
+    auto* choiceParam = descriptor.type == Params::Type::Choice ? static_cast<juce::AudioParameterChoice*>(&parameter) : nullptr;
+    auto* boolParam = descriptor.type == Params::Type::Bool ? static_cast<juce::AudioParameterBool*>(&parameter) : nullptr;
     
-    boolHelper(highBandComp.bypass, SimpleMBCompAudioProcessor::BYPASS_HIGH_BAND_ID.getParamID() );
-    boolHelper(highBandComp.solo, SimpleMBCompAudioProcessor::SOLO_HIGH_BAND_ID.getParamID() );
-    boolHelper(highBandComp.mute, SimpleMBCompAudioProcessor::MUTE_HIGH_BAND_ID.getParamID() );
+    auto band = [this, &descriptor]() -> CompressorBand&
+    {
+        jassert(juce::isPositiveAndBelow(descriptor.band, (int) compressorbands.size()));
+        return compressorbands[(size_t) descriptor.band];
+    };
     
-
-
+    switch(descriptor.binding)
+    {
+        case Params::Binding::InputGain:        inputGainParam = floatParam; break;
+        case Params::Binding::OutputGain:       outputGainParam = floatParam; break;
+        case Params::Binding::LowMidCrossover:  lowMidCrossover = floatParam; break;
+        case Params::Binding::MidHighCrossover: midHighCrossover = floatParam; break;
+        case Params::Binding::Threshold:        band().threshold = floatParam; break;
+        case Params::Binding::Attack:           band().attack = floatParam; break;
+        case Params::Binding::Release:          band().release = floatParam; break;
+        case Params::Binding::Ratio:            band().ratio = choiceParam; break;
+        case Params::Binding::Bypass:           band().bypass = boolParam; break;
+        case Params::Binding::Solo:             band().solo = boolParam; break;
+        case Params::Binding::Mute:             band().mute = boolParam; break;
+        case Params::Binding::AutoGain:         autoGainParam = boolParam; break;
+        case Params::Binding::ExternalKey:      externalKeyParam = boolParam; break;
+    }
 }
 
 SimpleMBCompAudioProcessor::~SimpleMBCompAudioProcessor()
@@ -180,8 +153,14 @@ void SimpleMBCompAudioProcessor::prepareToPlay (double sampleRate, int samplesPe
     inputGain.setRampDurationSeconds(0.05); //50 ms
     outputGain.setRampDurationSeconds(0.05); //50 ms
     
+    inputLoudness.prepare(sampleRate, (int) spec.numChannels);
+    outputLoudness.prepare(sampleRate, (int) spec.numChannels);
+    
+    // Hosts re-prepare after a bus layout change, so the sidechain state can be sized here
+    auto withSidechain = getChannelCountOfBus(true, 1) > 0;
+    
     for (auto& comp : compressorbands)
-        comp.prepare(spec);
+        comp.prepare(spec, withSidechain);
     
     LP1.prepare(spec);
     HP1.prepare(spec);
@@ -189,10 +168,29 @@ void SimpleMBCompAudioProcessor::prepareToPlay (double sampleRate, int samplesPe
     HP2.prepare(spec);
     AP2.prepare(spec);
     
-    for( auto& buffer : filterBuffers)
+    sidechainWasConnected = false;
+    
+    if(withSidechain)
     {
-        buffer.setSize(spec.numChannels, samplesPerBlock);
-    };
+        if(detector == nullptr)
+            detector = std::make_unique<DetectorCrossover>();
+        
+        auto detectorSpec = spec;
+        detectorSpec.numChannels = 1;
+        detector->lowMid.prepare(detectorSpec);
+        detector->midHigh.prepare(detectorSpec);
+    }
+    else
+    {
+        detector.reset();
+    }
+    
+    // Band buffers come from the arena shared by every instance in this process
+    jassert(spec.numChannels <= BandScratchArena::maxChannels);
+    scratchArena->bands.reserve(scratchArena.getReferenceCount());
+    
+    if(withSidechain)
+        scratchArena->detectors.reserve(scratchArena.getReferenceCount());
 }
 
 void SimpleMBCompAudioProcessor::releaseResources()
@@ -220,6 +218,16 @@ bool SimpleMBCompAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+    
+    // The optional sidechain can be disconnected, mono or stereo
+    if (layouts.inputBuses.size() > 1)
+    {
+        auto sidechain = layouts.getChannelSet(true, 1);
+        if (! sidechain.isDisabled()
+         && sidechain != juce::AudioChannelSet::mono()
+         && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -230,7 +238,7 @@ bool SimpleMBCompAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
 void SimpleMBCompAudioProcessor::updateState()
 {
     inputGain.setGainDecibels(inputGainParam->get() );
-    outputGain.setGainDecibels(outputGainParam->get());
+    outputGain.setGainDecibels(outputGainParam->get() + autoGainDecibels.load(std::memory_order_relaxed));
     
     for(auto& comp : compressorbands)
     {
@@ -249,60 +257,127 @@ void SimpleMBCompAudioProcessor::updateState()
     HP2.setCutoffFrequency(midHighCutoff);
 };
 
-void SimpleMBCompAudioProcessor::splitBands(juce::AudioBuffer<float>& buffer)
+void SimpleMBCompAudioProcessor::updateAutoGain(int numSamples)
 {
-    for(auto& fb : filterBuffers )
+    // Integrate the short-term difference at 0.2 dB per second per dB of error. That is
+    // well below the 3s short-term window, so the loop settles without overshooting.
+    constexpr auto correctionRate = 0.2f;
+    auto blockSeconds = (float) (numSamples / getSampleRate());
+    auto correction = autoGainDecibels.load(std::memory_order_relaxed);
+    
+    // Turning the mode off fades the correction out at the same rate, rather than
+    // jumping by up to 24 dB
+    if( autoGainParam->get() == false )
     {
-        fb = buffer;
-        
-    }
+        autoGainDecibels.store(correction - correction * juce::jmin(1.f, correctionRate * blockSeconds),
+                               std::memory_order_relaxed);
+        return;
+    };
+    
+    auto inputLUFS = inputLoudness.getShortTermLoudness();
+    auto outputLUFS = outputLoudness.getShortTermLoudness();
+    
+    // Hold the correction while either side is silent, so gaps in the program don't pump
+    if( inputLUFS <= LoudnessMeter::absoluteGate || outputLUFS <= LoudnessMeter::absoluteGate )
+        return;
+    
+    autoGainDecibels.store(juce::jlimit(-24.f, 24.f, correction + (inputLUFS - outputLUFS) * correctionRate * blockSeconds),
+                           std::memory_order_relaxed);
+};
+
+void SimpleMBCompAudioProcessor::updateDetectorState(bool justConnected)
+{
+    if(justConnected)
+    {
+        detector->lowMid.reset();
+        detector->midHigh.reset();
+    };
+    
+    detector->lowMid.setCutoffFrequency(lowMidCrossover->get());
+    detector->midHigh.setCutoffFrequency(midHighCrossover->get());
     
-    auto fb0Block = juce::dsp::AudioBlock<float>(filterBuffers[0]);
-    auto fb1Block = juce::dsp::AudioBlock<float>(filterBuffers[1]);
-    auto fb2Block = juce::dsp::AudioBlock<float>(filterBuffers[2]);
+    for(auto& comp : compressorbands)
+        comp.updateKeySettings(justConnected);
+};
+
+void SimpleMBCompAudioProcessor::splitDetectorBands(const juce::AudioBuffer<float>& sidechain, int startSample, int numSamples,
+                                                    const BandScratchArena::DetectorBuffers& detectorBands)
+{
+    jassert(numSamples <= detectorBands.numSamples);
+    
+    auto* low = detectorBands.bands[0];
+    auto* mid = detectorBands.bands[1];
+    auto* high = detectorBands.bands[2];
+    
+    // Sum the key down to mono in the high band, the filters below read it before overwriting it
+    auto numChannels = sidechain.getNumChannels();
+    auto channelGain = 1.f / (float) numChannels;
+    
+    juce::FloatVectorOperations::copyWithMultiply(high, sidechain.getReadPointer(0, startSample), channelGain, numSamples);
+    for(auto ch = 1; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::addWithMultiply(high, sidechain.getReadPointer(ch, startSample), channelGain, numSamples);
+    
+    for(auto i = 0; i < numSamples; ++i)
+    {
+        float rest;
+        detector->lowMid.processSample(0, high[i], low[i], rest);
+        detector->midHigh.processSample(0, rest, mid[i], high[i]);
+    };
+};
+
+void SimpleMBCompAudioProcessor::splitBands(const juce::dsp::AudioBlock<float>& input,
+                                            std::array<juce::dsp::AudioBlock<float>,3>& bands)
+{
+    bands[0].copyFrom(input);
+    bands[1].copyFrom(input);
     
-    auto fb0Ctx = juce::dsp::ProcessContextReplacing<float>(fb0Block);
-    auto fb1Ctx = juce::dsp::ProcessContextReplacing<float>(fb1Block);
-    auto fb2Ctx = juce::dsp::ProcessContextReplacing<float>(fb2Block);
+    auto fb0Ctx = juce::dsp::ProcessContextReplacing<float>(bands[0]);
+    auto fb1Ctx = juce::dsp::ProcessContextReplacing<float>(bands[1]);
+    auto fb2Ctx = juce::dsp::ProcessContextReplacing<float>(bands[2]);
     
     LP1.process(fb0Ctx);
     AP2.process(fb0Ctx);
     
     HP1.process(fb1Ctx);
-    filterBuffers[2] = filterBuffers[1];
+    bands[2].copyFrom(bands[1]);
     LP2.process(fb1Ctx);
     
     HP2.process(fb2Ctx);
 };
 
-void SimpleMBCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+void SimpleMBCompAudioProcessor::processBandsChunk(juce::AudioBuffer<float>& buffer, const juce::AudioBuffer<float>* sidechain,
+                                                   int startSample, int numSamples, const BandScratchArena::BandBuffers& scratch,
+                                                   const BandScratchArena::DetectorBuffers* detectorBands)
 {
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-    
-    updateState();
+    auto numChannels = buffer.getNumChannels();
+    jassert(numChannels <= BandScratchArena::maxChannels);
+    jassert(numSamples <= scratch.numSamples);
     
-    processGain(buffer, inputGain);
+    // AudioBlock only refers to the channel pointer arrays, which scratch keeps alive
+    std::array<juce::dsp::AudioBlock<float>, 3> bands;
     
-    splitBands(buffer);
+    for(size_t i = 0; i < bands.size(); ++i)
+        bands[i] = juce::dsp::AudioBlock<float>(scratch.channels[i].data(), (size_t) numChannels, (size_t) numSamples);
     
-    for( size_t i = 0; i < filterBuffers.size(); ++i)
-    {
-        if(compressorbands[i].bypass->get() == false )
-            compressorbands[i].process(filterBuffers[i]);
-    };
+    auto block = juce::dsp::AudioBlock<float>(buffer).getSubBlock((size_t) startSample, (size_t) numSamples);
     
+    splitBands(block, bands);
     
-    auto numSamples = buffer.getNumSamples();
-    auto numChannels = buffer.getNumChannels();
+    if(detectorBands != nullptr)
+        splitDetectorBands(*sidechain, startSample, numSamples, *detectorBands);
     
-
+    for( size_t i = 0; i < bands.size(); ++i)
+    {
+        if(compressorbands[i].bypass->get() )
+            continue;
+        
+        if(detectorBands != nullptr)
+            compressorbands[i].processKeyed(bands[i], detectorBands->bands[i]);
+        else
+            compressorbands[i].process(bands[i]);
+    };
     
-    buffer.clear();
+    block.clear();
     
     auto CompBandsAreSoloed = false;
     for(auto& comp: compressorbands)
@@ -315,23 +390,13 @@ void SimpleMBCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         
     };
     
-    
-    auto addFilterBand = [nc = numChannels, ns = numSamples](auto& inputBuffer, const auto& source)
-    {
-        for(auto i = 0; i < nc ; ++i)
-        {
-            // buffer.addFrom(int destChannel, int destStartSample, source buffer, int sourceChannel, int sourceStartSample, int NumSamples)
-            inputBuffer.addFrom(i, 0, source, i, 0, ns);
-        };
-    };
-    
     if(CompBandsAreSoloed)
     {
         for(size_t i = 0; i < compressorbands.size() ; ++i )
         {
             auto& comp = compressorbands[i];
           if(comp.solo->get() )
-              addFilterBand(buffer, filterBuffers[i]);
+              block.add(bands[i]);
         };
     }
     else{
@@ -339,14 +404,68 @@ void SimpleMBCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         {
             auto& comp = compressorbands[i];
           if(comp.mute->get() == false )
-              addFilterBand(buffer, filterBuffers[i]);
+              block.add(bands[i]);
         };
     }
-    processGain(buffer, outputGain);
+};
+
+void SimpleMBCompAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ScopedNoDenormals noDenormals;
+    auto totalNumInputChannels  = getMainBusNumInputChannels();
+    auto totalNumOutputChannels = getMainBusNumOutputChannels();
+
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+    
+    // The host buffer holds the sidechain channels after the main ones. An enabled bus may
+    // still carry nothing, so the detector path only runs while External Key is on (and the
+    // bus was there at prepareToPlay()). Otherwise the bands are keyed from their own signal.
+    auto mainBuffer = getBusBuffer(buffer, false, 0);
+    auto sidechainConnected = detector != nullptr && externalKeyParam->get() && getChannelCountOfBus(true, 1) > 0;
+    auto sidechainBuffer = sidechainConnected ? getBusBuffer(buffer, true, 1) : juce::AudioBuffer<float>();
+    
+    inputLoudness.process(mainBuffer);
+    
+    updateState();
+    
+    if(sidechainConnected)
+        updateDetectorState(sidechainWasConnected == false);
+    sidechainWasConnected = sidechainConnected;
+    
+    processGain(mainBuffer, inputGain);
+    
+    // The arena slabs have a fixed length, so hosts with larger blocks are split into chunks.
+    // If no slab is free (or prepareToPlay() hasn't run yet) the block goes through the
+    // small stack slab in shorter chunks instead, rather than waiting on the audio thread.
+    BandScratchArena::ScopedBands scratch(&scratchArena->bands);
+    BandScratchArena::StackBandSlab stackBands;
+    auto bandBuffers = scratch.isValid() ? scratch->getBuffers() : stackBands.getBuffers();
+    auto chunkSize = bandBuffers.numSamples;
+    
+    // Same for the detector bands, so a connected key is never dropped for a block
+    BandScratchArena::ScopedDetector detectorScratch(sidechainConnected ? &scratchArena->detectors : nullptr);
+    BandScratchArena::StackDetectorSlab stackDetector;
+    BandScratchArena::DetectorBuffers detectorBuffers {};
+    
+    if(sidechainConnected)
+    {
+        detectorBuffers = detectorScratch.isValid() ? detectorScratch->getBuffers() : stackDetector.getBuffers();
+        chunkSize = juce::jmin(chunkSize, detectorBuffers.numSamples);
+    };
+    
+    auto numSamples = mainBuffer.getNumSamples();
+    for(auto start = 0; start < numSamples; start += chunkSize)
+    {
+        processBandsChunk(mainBuffer, sidechainConnected ? &sidechainBuffer : nullptr,
+                          start, juce::jmin(chunkSize, numSamples - start),
+                          bandBuffers, sidechainConnected ? &detectorBuffers : nullptr);
+    };
+    
+    processGain(mainBuffer, outputGain);
     
-//    addFilterBand(buffer, filterBuffers[0]);
-//    addFilterBand(buffer, filterBuffers[1]);
-//    addFilterBand(buffer, filterBuffers[2]);
+    outputLoudness.process(mainBuffer);
+    updateAutoGain(numSamples);
 }
 
 //==============================================================================
@@ -368,8 +487,13 @@ void SimpleMBCompAudioProcessor::getStateInformation (juce::MemoryBlock& destDat
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     
+    // The auto gain correction isn't a parameter, so it rides along as a property of the
+    // saved tree. Otherwise a reload would start it over from 0 dB and audibly drift back.
+    auto state = apvts.copyState();
+    state.setProperty(Params::autoGainCorrectionProperty, autoGainDecibels.load(), nullptr);
+    
     juce::MemoryOutputStream MemoryOutputStream(destData, true);
-    apvts.state.writeToStream(MemoryOutputStream);
+    state.writeToStream(MemoryOutputStream);
 }
 
 void SimpleMBCompAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -381,77 +505,40 @@ void SimpleMBCompAudioProcessor::setStateInformation (const void* data, int size
     if( tree.isValid() )
     {
         apvts.replaceState(tree);
+        
+        // Sessions saved before the correction was stored start over from 0 dB
+        auto correction = (float) tree.getProperty(Params::autoGainCorrectionProperty, 0.f);
+        autoGainDecibels.store(juce::jlimit(-24.f, 24.f, correction));
     }
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout SimpleMBCompAudioProcessor::createParameterLayout(){
-//    juce::AudioProcessorValueTreeState::ParameterLayout layout;
-    
-
     
     // Create a std::vector with a ranged audio parameter template and add all of the unique pointers to it
     std::vector<std::unique_ptr<juce::RangedAudioParameter>> vecParams;
+    vecParams.reserve(Params::numParameters);
     
-    auto gainRange = juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f);
-    
-    juce::NormalisableRange<float> thresholdRange = juce::NormalisableRange<float>(-60, +12, 1, 1);
-    
-    auto attackReleaseRange =  juce::NormalisableRange<float>(5, 500, 1, 1); // Set the attack Release range to a minimal time of 5ms and maximal range of 500ms with a linear step with a skew factor 1
-
-    auto ratioChoices = std::vector<double>{1, 1.5, 2, 3, 4, 5, 6, 7, 8, 10, 15, 20, 50, 100};
-    juce::StringArray sa;
-    for(auto choice: ratioChoices)
+    for(const auto& d : Params::descriptors)
     {
-        sa.add( juce::String(choice, 1) );
-    };
-    
-    auto LOW_MID_crossoverFreqRange = juce::NormalisableRange<float>(20, 999, 1, 1);
-    auto MID_HIGH_crossoverFreqRange = juce::NormalisableRange<float>(1000, 20000, 1, 1);
-    
-    // Input and Output Gain
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(GAIN_IN_ID, GAIN_IN_NAME, gainRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(GAIN_OUT_ID, GAIN_OUT_NAME, gainRange, 0));
-    
-    
-    //Low Band Compressor
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(THRESHOLD_LOW_BAND_ID, THRESHOLD_LOW_BAND_NAME, thresholdRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(ATTACK_LOW_BAND_ID, ATTACK_LOW_BAND_NAME, attackReleaseRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(RELEASE_LOW_BAND_ID, RELEASE_LOW_BAND_NAME, attackReleaseRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterChoice>(RATIO_LOW_BAND_ID, RATIO_LOW_BAND_NAME, sa, 3));
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( BYPASS_LOW_BAND_ID, BYPASS_LOW_BAND_NAME, false));
-    
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( SOLO_LOW_BAND_ID, SOLO_LOW_BAND_NAME, false));
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( MUTE_LOW_BAND_ID, MUTE_LOW_BAND_NAME, false));
-    
-    // Mid Band Compressor
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(THRESHOLD_MID_BAND_ID, THRESHOLD_MID_BAND_NAME, thresholdRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(ATTACK_MID_BAND_ID, ATTACK_MID_BAND_NAME, attackReleaseRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(RELEASE_MID_BAND_ID, RELEASE_MID_BAND_NAME, attackReleaseRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterChoice>(RATIO_MID_BAND_ID, RATIO_MID_BAND_NAME, sa, 3));
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( BYPASS_MID_BAND_ID, BYPASS_MID_BAND_NAME, false));
-    
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( SOLO_MID_BAND_ID, SOLO_MID_BAND_NAME, false));
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( MUTE_MID_BAND_ID, MUTE_MID_BAND_NAME, false));
-    
-    // High Band Compressor
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(THRESHOLD_HIGH_BAND_ID, THRESHOLD_HIGH_BAND_NAME, thresholdRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(ATTACK_HIGH_BAND_ID, ATTACK_HIGH_BAND_NAME, attackReleaseRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(RELEASE_HIGH_BAND_ID, RELEASE_HIGH_BAND_NAME, attackReleaseRange, 0));
-    vecParams.push_back(std::make_unique<juce::AudioParameterChoice>(RATIO_HIGH_BAND_ID, RATIO_HIGH_BAND_NAME, sa, 3));
-    
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( BYPASS_HIGH_BAND_ID, BYPASS_HIGH_BAND_NAME, false));
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( SOLO_HIGH_BAND_ID, SOLO_HIGH_BAND_NAME, false));
-    vecParams.push_back(std::make_unique<juce::AudioParameterBool>( MUTE_HIGH_BAND_ID, MUTE_HIGH_BAND_NAME, false));
-    
-    //Crossover Freq Parameters
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(LOW_MID_CROSSOVER_FREQ_ID, LOW_MID_CROSSOVER_FREQ_NAME, LOW_MID_crossoverFreqRange , 400 ));
-    vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(MID_HIGH_CROSSOVER_FREQ_ID, MID_HIGH_CROSSOVER_FREQ_NAME, MID_HIGH_crossoverFreqRange , 2000 ));
-//
-//    // Loop over this vector and add the resp. parameterIDs to the parameterlist stringArray
-//    for (const auto& param : vecParams){
-//        parameterList.add(param->getParameterID());
-//    }
-
+        auto id = juce::ParameterID { d.id, Params::versionHint };
+        
+        switch(d.type)
+        {
+            case Params::Type::Float:
+                vecParams.push_back(std::make_unique<juce::AudioParameterFloat>(id, d.name,
+                                                                                 juce::NormalisableRange<float>(d.range.start, d.range.end, d.range.interval, d.range.skew),
+                                                                                 d.defaultValue));
+                break;
+            case Params::Type::Choice:
+                vecParams.push_back(std::make_unique<juce::AudioParameterChoice>(id, d.name,
+                                                                                  juce::StringArray(d.choiceNames, d.numChoices),
+                                                                                  (int) d.defaultValue));
+                break;
+            case Params::Type::Bool:
+                vecParams.push_back(std::make_unique<juce::AudioParameterBool>(id, d.name, d.defaultValue != 0.f));
+                break;
+        }
+    }
 
     return {vecParams.begin(), vecParams.end()};
 
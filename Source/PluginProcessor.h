@@ -28,6 +28,9 @@
  */
 
 #include <JuceHeader.h>
+#include "BandScratchArena.h"
+#include "Params.h"
+#include "LoudnessMeter.h"
 
 //==============================================================================
 /**
@@ -48,9 +51,22 @@ struct CompressorBand
     juce::AudioParameterBool* solo { nullptr };
     juce::AudioParameterBool* mute { nullptr };
     
-    void prepare(const juce::dsp::ProcessSpec& spec)
+    // The key envelope only exists while the sidechain bus is enabled
+    void prepare(const juce::dsp::ProcessSpec& spec, bool withSidechain)
     {
         compressor.prepare(spec);
+        
+        if(withSidechain == false)
+        {
+            key.reset();
+            return;
+        }
+        
+        if(key == nullptr)
+            key = std::make_unique<SidechainKey>();
+        
+        key->envelope.prepare({ spec.sampleRate, spec.maximumBlockSize, 1 });
+        key->envelope.setLevelCalculationType(juce::dsp::BallisticsFilterLevelCalculationType::peak);
     };
     
     void updateCompressorSettings()
@@ -58,21 +74,61 @@ struct CompressorBand
         compressor.setAttack(attack->get());
         compressor.setRelease(release->get());
         compressor.setThreshold(threshold->get());
-        compressor.setRatio(ratio->getCurrentChoiceName().getFloatValue());
+        compressor.setRatio(Params::ratioChoices[(size_t) ratio->getIndex()]);
     };
     
-    void process(juce::AudioBuffer<float>& buffer)
+    // Only needed while a sidechain is connected
+    void updateKeySettings(bool resetEnvelope)
+    {
+        jassert(key != nullptr);
+        
+        if(resetEnvelope)
+            key->envelope.reset();
+        
+        key->envelope.setAttackTime(attack->get());
+        key->envelope.setReleaseTime(release->get());
+        
+        key->thresholdGain = juce::Decibels::decibelsToGain(threshold->get());
+        key->ratioExponent = 1.f / Params::ratioChoices[(size_t) ratio->getIndex()] - 1.f;
+    };
+    
+    void process(juce::dsp::AudioBlock<float> block)
     {
-        auto block = juce::dsp::AudioBlock<float>(buffer);
         auto context = juce::dsp::ProcessContextReplacing<float>(block);
         
         context.isBypassed = bypass->get();
         compressor.process(context);
 
     };
+    
+    // Same gain law as juce::dsp::Compressor, but the envelope follows the mono key
+    // signal instead of the audio, and the resulting gain is applied to every channel
+    void processKeyed(juce::dsp::AudioBlock<float> block, const float* keySignal)
+    {
+        jassert(key != nullptr);
+        auto numChannels = block.getNumChannels();
+        
+        for(size_t i = 0; i < block.getNumSamples(); ++i)
+        {
+            auto env = key->envelope.processSample(0, keySignal[i]);
+            auto gain = env < key->thresholdGain ? 1.f : std::pow(env / key->thresholdGain, key->ratioExponent);
+            
+            for(size_t ch = 0; ch < numChannels; ++ch)
+                block.getChannelPointer(ch)[i] *= gain;
+        };
+    };
 private:
     juce::dsp::Compressor<float> compressor;
     
+    struct SidechainKey
+    {
+        juce::dsp::BallisticsFilter<float> envelope;
+        float thresholdGain { 1.f };
+        float ratioExponent { 0.f };
+    };
+    
+    std::unique_ptr<SidechainKey> key;
+    
     
 };
 class SimpleMBCompAudioProcessor  : public juce::AudioProcessor
@@ -81,79 +137,6 @@ class SimpleMBCompAudioProcessor  : public juce::AudioProcessor
                             #endif
 {
 public:
-    inline static const juce::String
-    
-            LOW_MID_CROSSOVER_FREQ_NAME = "Low-Mid Crossover Freq",
-            MID_HIGH_CROSSOVER_FREQ_NAME = "Mid-High Crossover Freq",
-            
-            THRESHOLD_LOW_BAND_NAME = "Threshold Low Band",
-            THRESHOLD_MID_BAND_NAME = "Threshold Mid Band",
-            THRESHOLD_HIGH_BAND_NAME = "Threshold High Band",
-            
-            ATTACK_LOW_BAND_NAME = "Attack Low Band",
-            ATTACK_MID_BAND_NAME = "Attack Mid Band",
-            ATTACK_HIGH_BAND_NAME = "Attack High Band",
-            
-            RELEASE_LOW_BAND_NAME = "Release Low Band",
-            RELEASE_MID_BAND_NAME = "Release Mid Band",
-            RELEASE_HIGH_BAND_NAME = "Release High Band",
-            
-            RATIO_LOW_BAND_NAME = "Ratio Low Band",
-            RATIO_MID_BAND_NAME = "Ratio Mid Band",
-            RATIO_HIGH_BAND_NAME = "Ratio High Band",
-            
-            BYPASS_LOW_BAND_NAME = "Bypass Low Band",
-            BYPASS_MID_BAND_NAME = "Bypass Mid Band",
-            BYPASS_HIGH_BAND_NAME = "Bypass High Band",
-    
-            MUTE_LOW_BAND_NAME = "Mute Low Band",
-            MUTE_MID_BAND_NAME = "Mute Mid Band",
-            MUTE_HIGH_BAND_NAME = "Mute High Band",
-            
-            SOLO_LOW_BAND_NAME = "Solo Low Band",
-            SOLO_MID_BAND_NAME = "Solo Mid Band",
-            SOLO_HIGH_BAND_NAME = "Solo High Band",
-    
-            GAIN_IN_NAME = "Input Gain",
-            GAIN_OUT_NAME = "Output Gain"
-    ;
-
-
-    inline static const juce::ParameterID
-            LOW_MID_CROSSOVER_FREQ_ID = {"Low_Mid_Crossover_Freq",1},
-            MID_HIGH_CROSSOVER_FREQ_ID = {"Mid-High Crossover Freq",1},
-            
-            THRESHOLD_LOW_BAND_ID ={"Threshold_Low_Band",1},
-            THRESHOLD_MID_BAND_ID= {"Threshold_Mid_Band",1},
-            THRESHOLD_HIGH_BAND_ID= {"Threshold_High_Band",1},
-            
-            ATTACK_LOW_BAND_ID= {"Attack_Low_Band", 1},
-            ATTACK_MID_BAND_ID= {"Attack_Mid_Band",1},
-            ATTACK_HIGH_BAND_ID= {"Attack_High_Band",1},
-            
-            RELEASE_LOW_BAND_ID= {"Release_Low_Band",1},
-            RELEASE_MID_BAND_ID= {"Release_Mid_Band",1},
-            RELEASE_HIGH_BAND_ID= {"Release_High_Band", 1},
-            
-            RATIO_LOW_BAND_ID= {"Ratio_Low_Band", 1},
-            RATIO_MID_BAND_ID= {"Ratio_Mid_Band", 1},
-            RATIO_HIGH_BAND_ID= {"Ratio_High_Band", 1},
-            
-            BYPASS_LOW_BAND_ID= {"Bypass_Low_Band", 1},
-            BYPASS_MID_BAND_ID= {"Bypass_Mid_Band",1},
-            BYPASS_HIGH_BAND_ID= {"Bypass_High_Band", 1},
-    
-            MUTE_LOW_BAND_ID= {"Mute_Low_Band", 1},
-            MUTE_MID_BAND_ID= {"Mute_Mid_Band",1},
-            MUTE_HIGH_BAND_ID= {"Mute_High_Band", 1},
-    
-            SOLO_LOW_BAND_ID= {"Solo_Low_Band", 1},
-            SOLO_MID_BAND_ID= {"Solo_Mid_Band",1},
-            SOLO_HIGH_BAND_ID= {"Solo_High_Band", 1},
-    
-            GAIN_IN_ID= {"Input_Gain",1},
-            GAIN_OUT_ID= {"Output_Gain", 1}
-       ;
     //==============================================================================
     SimpleMBCompAudioProcessor();
     ~SimpleMBCompAudioProcessor() override;
@@ -193,6 +176,10 @@ public:
     
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     
+    // Loudness of the signal coming into and going out of processBlock()
+    const LoudnessMeter& getInputLoudnessMeter() const { return inputLoudness; }
+    const LoudnessMeter& getOutputLoudnessMeter() const { return outputLoudness; }
+    
     
     juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters", createParameterLayout()};
 private:
@@ -209,17 +196,39 @@ private:
             HP1, LP2, //Set HP1 to LowMidCutoff
                 HP2;    // Set HP2 and LP2 to MidHighCutoff
     
+    // Detector-only crossover for the sidechain. It never produces audio, so it runs
+    // in mono and skips the allpass that keeps the audio bands phase aligned. Each filter
+    // produces its low and high outputs in one processSample() call, so no type is set.
+    // Only allocated by prepareToPlay() while the sidechain bus is enabled.
+    struct DetectorCrossover
+    {
+        Filter lowMid, midHigh;
+    };
+    
+    std::unique_ptr<DetectorCrossover> detector;
+    bool sidechainWasConnected { false };
+    juce::AudioParameterBool* externalKeyParam { nullptr };
+    
     juce::AudioParameterFloat* lowMidCrossover { nullptr };
     
     juce::AudioParameterFloat* midHighCrossover { nullptr };
     
-    std::array<juce::AudioBuffer<float>,3> filterBuffers;
+    // Band buffers are borrowed from the shared arena for each processBlock() call,
+    // only the filter and compressor state above is owned per instance
+    juce::SharedResourcePointer<BandScratchArena> scratchArena;
     
     juce::dsp::Gain<float> inputGain, outputGain;
     
     juce::AudioParameterFloat* inputGainParam { nullptr };
     juce::AudioParameterFloat* outputGainParam { nullptr };
     
+    LoudnessMeter inputLoudness, outputLoudness;
+    
+    // Slowly integrated correction on top of outputGainParam, only used when autoGainParam is on
+    juce::AudioParameterBool* autoGainParam { nullptr };
+    // Written by the audio thread, read and restored by the state methods on the message thread
+    std::atomic<float> autoGainDecibels { 0.f };
+    
     template<typename T, typename U>
     void processGain(T& buffer, U& gain)
     {
@@ -228,9 +237,19 @@ private:
         gain.process(context);
     };
     
+    void bindParameter(const Params::Descriptor& descriptor, juce::AudioProcessorParameter& parameter);
+    
     //Process Block Helper functions
     void updateState();
-    void splitBands(juce::AudioBuffer<float>& buffer);
+    void updateAutoGain(int numSamples);
+    void updateDetectorState(bool justConnected);
+    void splitBands(const juce::dsp::AudioBlock<float>& input,
+                    std::array<juce::dsp::AudioBlock<float>,3>& bands);
+    void splitDetectorBands(const juce::AudioBuffer<float>& sidechain, int startSample, int numSamples,
+                            const BandScratchArena::DetectorBuffers& detectorBands);
+    void processBandsChunk(juce::AudioBuffer<float>& buffer, const juce::AudioBuffer<float>* sidechain,
+                           int startSample, int numSamples, const BandScratchArena::BandBuffers& scratch,
+                           const BandScratchArena::DetectorBuffers* detectorBands);
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SimpleMBCompAudioProcessor)
 };